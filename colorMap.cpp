@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <cmath>
+#include "headers/colorMap.h"
+
+namespace render {
+    // Speeds are in pixels per second (7 pixels per substep at 8 substeps and 60 fps)
+    constexpr float MIN_SPEED = 0.0f;
+    constexpr float MAX_SPEED = 7.0f * 8 * 60;
+    constexpr float MAX_SPEED_SQ = MAX_SPEED * MAX_SPEED;
+
+    // Neighbour count mapped to the hottest colour
+    constexpr int MAX_NEIGHBOURS = 16;
+
+    // Color gradient from cold (blue) to hot (red), t in [0, 1]
+    static sf::Color gradient(float t) {
+        static const std::array<sf::Color, 5> colors = {
+            sf::Color(0, 0, 255), // Blue (cold)
+            sf::Color(0, 255, 255), // Cyan
+            sf::Color(0, 255, 0), // Green
+            sf::Color(255, 255, 0), // Yellow
+            sf::Color(255, 0, 0) // Red (hot)
+        };
+
+        float colorIndex = std::clamp(t, 0.0f, 1.0f) * (colors.size() - 1);
+        int index1 = static_cast<int>(colorIndex);
+        int index2 = std::min(index1 + 1, static_cast<int>(colors.size() - 1));
+        float f = colorIndex - index1;
+
+        sf::Color color;
+        color.r = static_cast<sf::Uint8>(colors[index1].r + f * (colors[index2].r - colors[index1].r));
+        color.g = static_cast<sf::Uint8>(colors[index1].g + f * (colors[index2].g - colors[index1].g));
+        color.b = static_cast<sf::Uint8>(colors[index1].b + f * (colors[index2].b - colors[index1].b));
+        return color;
+    }
+
+    ColorMap::ColorMap() {
+        // Speed LUT is indexed by speed squared, the sqrt is paid here once per entry
+        for (int i = 0; i < LUT_SIZE; i++) {
+            float speedSq = MAX_SPEED_SQ * i / (LUT_SIZE - 1);
+            float speed = std::sqrt(speedSq);
+            speedLut[i] = gradient((speed - MIN_SPEED) / (MAX_SPEED - MIN_SPEED));
+            pressureLut[i] = gradient(static_cast<float>(i) / (LUT_SIZE - 1));
+        }
+    }
+
+    sf::Color ColorMap::fromSpeedSq(float speedSq) const {
+        int index = static_cast<int>(speedSq * ((LUT_SIZE - 1) / MAX_SPEED_SQ));
+        return speedLut[std::clamp(index, 0, LUT_SIZE - 1)];
+    }
+
+    sf::Color ColorMap::fromNeighbourCount(int count) const {
+        int index = count * (LUT_SIZE - 1) / MAX_NEIGHBOURS;
+        return pressureLut[std::clamp(index, 0, LUT_SIZE - 1)];
+    }
+
+    sf::Color ColorMap::fromCellIndex(int cellIndex) const {
+        // Integer hash so neighbouring cells get unrelated colours
+        unsigned int h = static_cast<unsigned int>(cellIndex) * 2654435761u;
+        h ^= h >> 16;
+        return sf::Color(64 + (h & 0xBF), 64 + ((h >> 8) & 0xBF), 64 + ((h >> 16) & 0xBF));
+    }
+}
@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "headers/domain.h"
+#include "headers/simulation.h"
+
+// Linux flags each send, macOS has no MSG_NOSIGNAL and sets SO_NOSIGPIPE on the socket instead (openSocketPair)
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace domain {
+    namespace {
+        struct WireParticle {
+            float x, y;
+            float oldX, oldY;
+            // Forces accumulated for the current frame, a migrant keeps them on its new strip
+            float accelerationX, accelerationY;
+        };
+
+        WireParticle toWire(const prtcl::Particle &p) {
+            return {
+                p.position.x, p.position.y, p.oldPosition.x, p.oldPosition.y, p.acceleration.x, p.acceleration.y
+            };
+        }
+
+        void fromWire(prtcl::Particle &p, const WireParticle &w) {
+            p.position = {w.x, w.y};
+            p.oldPosition = {w.oldX, w.oldY};
+            p.acceleration = {w.accelerationX, w.accelerationY};
+        }
+
+        enum class Command : uint32_t {
+            Step,
+            Quit
+        };
+
+        struct Request {
+            Command command;
+            uint32_t wantFrame;
+            float dt;
+        };
+
+        void writeAll(int fd, const void *data, size_t size) {
+            const char *bytes = static_cast<const char *>(data);
+            while (size > 0) {
+                ssize_t written = send(fd, bytes, size, MSG_NOSIGNAL);
+                if (written <= 0) throw std::runtime_error("domain: peer closed the connection");
+                bytes += written;
+                size -= written;
+            }
+        }
+
+        // A peer that died must show up as a failed send, not as a SIGPIPE killing this process
+        bool openSocketPair(std::array<int, 2> &pair) {
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair.data()) != 0) return false;
+#ifdef SO_NOSIGPIPE
+            int on = 1;
+            for (int fd: pair) {
+                setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+            }
+#endif
+            return true;
+        }
+
+        void closeSockets(std::vector<std::array<int, 2> > &pairs) {
+            for (auto &pair: pairs) {
+                for (int &fd: pair) {
+                    if (fd >= 0) close(fd);
+                    fd = -1;
+                }
+            }
+        }
+
+        void readAll(int fd, void *data, size_t size) {
+            char *bytes = static_cast<char *>(data);
+            while (size > 0) {
+                ssize_t received = recv(fd, bytes, size, 0);
+                if (received <= 0) throw std::runtime_error("domain: peer closed the connection");
+                bytes += received;
+                size -= received;
+            }
+        }
+
+        // Owns one strip and talks to the coordinator and to its left/right neighbours
+        class Worker {
+            int rank;
+            int control, left, right; // -1 when there's no neighbour on that side
+            sim::Simulation sim;
+
+            std::vector<WireParticle> leftMigrants, rightMigrants;
+            std::vector<WireParticle> leftGhosts, rightGhosts;
+            std::vector<WireParticle> incoming;
+            std::vector<sf::Vector2f> frame;
+            size_t ghostCount = 0;
+
+            void addGhost(const WireParticle &w) {
+                std::vector<prtcl::Particle> &ghosts = sim.getGhosts();
+                if (ghostCount == ghosts.size()) {
+                    ghosts.emplace_back(w.x, w.y);
+                }
+                fromWire(ghosts[ghostCount], w);
+                ghostCount++;
+            }
+
+            void sendBoundary(int fd, const std::vector<WireParticle> &migrants,
+                              const std::vector<WireParticle> &ghosts) {
+                std::array<uint32_t, 2> header = {
+                    static_cast<uint32_t>(migrants.size()), static_cast<uint32_t>(ghosts.size())
+                };
+                writeAll(fd, header.data(), sizeof(header));
+                writeAll(fd, migrants.data(), migrants.size() * sizeof(WireParticle));
+                writeAll(fd, ghosts.data(), ghosts.size() * sizeof(WireParticle));
+            }
+
+            void receiveBoundary(int fd) {
+                std::array<uint32_t, 2> header{};
+                readAll(fd, header.data(), sizeof(header));
+                incoming.resize(header[0] + header[1]);
+                readAll(fd, incoming.data(), incoming.size() * sizeof(WireParticle));
+
+                std::vector<prtcl::Particle> &particles = sim.getParticle();
+                for (uint32_t i = 0; i < header[0]; i++) {
+                    particles.emplace_back(incoming[i].x, incoming[i].y);
+                    fromWire(particles.back(), incoming[i]);
+                }
+                for (uint32_t i = header[0]; i < incoming.size(); i++) {
+                    addGhost(incoming[i]);
+                }
+            }
+
+            // Lower rank sends first, so large messages can't block both ends of a socket
+            void trade(int fd, bool lowerRank, const std::vector<WireParticle> &migrants,
+                       const std::vector<WireParticle> &ghosts) {
+                if (lowerRank) {
+                    sendBoundary(fd, migrants, ghosts);
+                    receiveBoundary(fd);
+                } else {
+                    receiveBoundary(fd);
+                    sendBoundary(fd, migrants, ghosts);
+                }
+            }
+
+            void exchange(sim::Simulation &s) {
+                const float minX = s.getMinX();
+                const float maxX = s.getMaxX();
+                // Anything closer than a diameter to the edge can touch the neighbour's particles
+                const float ghostWidth = 2 * prtcl::Particle::radius;
+
+                leftMigrants.clear();
+                rightMigrants.clear();
+                leftGhosts.clear();
+                rightGhosts.clear();
+                ghostCount = 0;
+
+                std::vector<prtcl::Particle> &particles = s.getParticle();
+                for (size_t i = 0; i < particles.size();) {
+                    const prtcl::Particle &p = particles[i];
+                    WireParticle w = toWire(p);
+
+                    // Particles that crossed an edge change owner, the old owner keeps them as ghosts for this substep
+                    bool toLeft = left >= 0 && w.x < minX;
+                    bool toRight = right >= 0 && w.x >= maxX;
+                    if (toLeft || toRight) {
+                        (toLeft ? leftMigrants : rightMigrants).push_back(w);
+                        addGhost(w);
+                        if (i + 1 < particles.size()) particles[i] = std::move(particles.back());
+                        particles.pop_back();
+                        continue;
+                    }
+
+                    if (left >= 0 && w.x < minX + ghostWidth) leftGhosts.push_back(w);
+                    if (right >= 0 && w.x >= maxX - ghostWidth) rightGhosts.push_back(w);
+                    i++;
+                }
+
+                // Even then odd boundaries, every worker is on at most one boundary per phase
+                for (int phase = 0; phase < 2; phase++) {
+                    if (right >= 0 && rank % 2 == phase) trade(right, true, rightMigrants, rightGhosts);
+                    if (left >= 0 && (rank - 1) % 2 == phase) trade(left, false, leftMigrants, leftGhosts);
+                }
+
+                std::vector<prtcl::Particle> &ghosts = s.getGhosts();
+                ghosts.erase(ghosts.begin() + ghostCount, ghosts.end());
+            }
+
+        public:
+            Worker(int rank, int control, int left, int right, int width, int height,
+                   const std::vector<sf::Vector2f> &positions, int substeps, float minX, float maxX, int threads)
+                : rank(rank),
+                  control(control),
+                  left(left),
+                  right(right),
+                  sim(width, height, positions, substeps, minX, maxX, threads) {
+                sim.setBoundaryExchange([this](sim::Simulation &s) { exchange(s); });
+            }
+
+            sim::Simulation &getSimulation() {
+                return sim;
+            }
+
+            void run() {
+                for (;;) {
+                    Request request{};
+                    readAll(control, &request, sizeof(request));
+                    if (request.command == Command::Quit) return;
+
+                    sim.update(request.dt);
+
+                    const std::vector<prtcl::Particle> &particles = sim.getParticle();
+                    uint32_t count = static_cast<uint32_t>(particles.size());
+                    writeAll(control, &count, sizeof(count));
+                    if (request.wantFrame) {
+                        frame.resize(count);
+                        for (uint32_t i = 0; i < count; i++) {
+                            frame[i] = particles[i].position;
+                        }
+                        writeAll(control, frame.data(), frame.size() * sizeof(sf::Vector2f));
+                    }
+                }
+            }
+        };
+    }
+
+    Coordinator::Coordinator(int width, int height, int numParticles, int processCount, int substeps,
+                             int threadsPerProcess, const std::string &sceneFile)
+        : Coordinator(width, height, sim::Simulation::spawnPositions(numParticles), processCount, substeps,
+                      threadsPerProcess, sceneFile) {
+    }
+
+    Coordinator::Coordinator(int width, int height, const std::vector<sf::Vector2f> &positions, int processCount,
+                             int substeps, int threadsPerProcess, const std::string &sceneFile) {
+        processCount = std::max(1, processCount);
+        threadsPerProcess = std::max(1, threadsPerProcess);
+
+        particleCount = static_cast<int>(positions.size());
+        stripCounts.assign(processCount, 0);
+
+        // Every socket is created up front, each child then closes the ends it doesn't use
+        std::vector<std::array<int, 2> > controlPairs(processCount, {-1, -1});
+        std::vector<std::array<int, 2> > links(processCount - 1, {-1, -1});
+        for (auto *pairs: {&controlPairs, &links}) {
+            for (auto &pair: *pairs) {
+                if (!openSocketPair(pair)) {
+                    closeSockets(controlPairs);
+                    closeSockets(links);
+                    throw std::runtime_error("domain: socketpair failed");
+                }
+            }
+        }
+
+        const float stripWidth = static_cast<float>(width) / processCount;
+        for (int rank = 0; rank < processCount; rank++) {
+            float minX = rank * stripWidth;
+            float maxX = (rank == processCount - 1) ? static_cast<float>(width) : (rank + 1) * stripWidth;
+
+            pid_t pid = fork();
+            if (pid < 0) {
+                // Workers already started get Quit, every other end is closed so none of them waits on a link
+                for (size_t i = 0; i < workers.size(); i++) {
+                    controls.push_back(controlPairs[i][0]);
+                    controlPairs[i][0] = -1;
+                }
+                closeSockets(controlPairs);
+                closeSockets(links);
+                shutdown();
+                throw std::runtime_error("domain: fork failed");
+            }
+            if (pid > 0) {
+                workers.push_back(pid);
+                continue;
+            }
+
+            // Worker process
+            int control = controlPairs[rank][1];
+            int left = rank > 0 ? links[rank - 1][1] : -1;
+            int right = rank < processCount - 1 ? links[rank][0] : -1;
+            for (auto &pair: controlPairs) {
+                for (int fd: pair) if (fd != control) close(fd);
+            }
+            for (auto &pair: links) {
+                for (int fd: pair) if (fd != left && fd != right) close(fd);
+            }
+
+            int exitCode = 0;
+            try {
+                // Edge strips also take whatever lies outside the world
+                std::vector<sf::Vector2f> owned;
+                for (auto &pos: positions) {
+                    bool afterMin = rank == 0 || pos.x >= minX;
+                    bool beforeMax = rank == processCount - 1 || pos.x < maxX;
+                    if (afterMin && beforeMax) owned.push_back(pos);
+                }
+
+                Worker worker(rank, control, left, right, width, height, owned, substeps, minX, maxX,
+                              threadsPerProcess);
+                // Errors are reported by whoever picked the scene, a worker just runs without it
+                std::string sceneError;
+                if (!sceneFile.empty()) worker.getSimulation().loadScene(sceneFile, sceneError);
+                worker.run();
+            } catch (const std::exception &e) {
+                std::cerr << "domain worker " << rank << ": " << e.what() << std::endl;
+                exitCode = 1;
+            }
+            _exit(exitCode);
+        }
+
+        for (auto &pair: controlPairs) {
+            controls.push_back(pair[0]);
+            pair[0] = -1;
+        }
+        closeSockets(controlPairs);
+        closeSockets(links);
+        frame.reserve(particleCount);
+    }
+
+    Coordinator::~Coordinator() {
+        shutdown();
+    }
+
+    void Coordinator::shutdown() {
+        Request request{Command::Quit, 0, 0.0f};
+        for (int fd: controls) {
+            send(fd, &request, sizeof(request), MSG_NOSIGNAL);
+            close(fd);
+        }
+        controls.clear();
+        for (pid_t pid: workers) {
+            waitpid(pid, nullptr, 0);
+        }
+        workers.clear();
+    }
+
+    void Coordinator::step(float dt, bool wantFrame) {
+        // Start every strip before waiting on any of them
+        Request request{Command::Step, wantFrame ? 1u : 0u, dt};
+        for (int fd: controls) {
+            writeAll(fd, &request, sizeof(request));
+        }
+
+        int total = 0;
+        if (wantFrame) frame.clear();
+        for (size_t i = 0; i < controls.size(); i++) {
+            int fd = controls[i];
+            uint32_t count = 0;
+            readAll(fd, &count, sizeof(count));
+            stripCounts[i] = static_cast<int>(count);
+            if (wantFrame) {
+                frame.resize(total + count);
+                readAll(fd, frame.data() + total, count * sizeof(sf::Vector2f));
+            }
+            total += static_cast<int>(count);
+        }
+        particleCount = total;
+    }
+
+    const std::vector<sf::Vector2f> &Coordinator::getFrame() const {
+        return frame;
+    }
+
+    int Coordinator::getParticleCount() const {
+        return particleCount;
+    }
+
+    const std::vector<int> &Coordinator::getStripCounts() const {
+        return stripCounts;
+    }
+
+    int Coordinator::getProcessCount() const {
+        return static_cast<int>(workers.size());
+    }
+}
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "headers/domain.h"
+
+// Headless scaling run: same world split over 1, 2, 4... worker processes
+// usage: domainBenchmark [particles] [frames] [maxProcesses]
+int main(int argc, char **argv) {
+    const int NUM_PARTICLES = argc > 1 ? std::stoi(argv[1]) : 200000;
+    const int FRAMES = argc > 2 ? std::stoi(argv[2]) : 60;
+    const int HARDWARE_THREADS = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const int MAX_PROCESSES = argc > 3 ? std::stoi(argv[3]) : HARDWARE_THREADS;
+    const int WARMUP_FRAMES = 10;
+    const float STEPTIME = 1.f / 60.f;
+    const int SUBSTEPS = 8;
+
+    // Room for a square block with 10px spacing, laid out twice as wide so strips stay narrow
+    const int side = static_cast<int>(std::ceil(std::sqrt(NUM_PARTICLES))) * 10 + 20;
+    const int WIDTH = side * 2;
+    const int HEIGHT = side;
+
+    // Rows spread over the whole width, so every strip starts and settles with the same share
+    const float SPACING = 10.f;
+    const float MARGIN = 20.f;
+    const int columns = static_cast<int>((WIDTH - 2 * MARGIN) / SPACING);
+    std::vector<sf::Vector2f> positions;
+    for (int i = 0; i < NUM_PARTICLES; i++) {
+        positions.emplace_back(MARGIN + (i % columns) * SPACING, MARGIN + (i / columns) * SPACING);
+    }
+
+    std::cout << NUM_PARTICLES << " particles, " << WIDTH << "x" << HEIGHT << " world, " << FRAMES << " frames, "
+            << SUBSTEPS << " substeps" << std::endl;
+    std::cout << "processes  threads/proc  ms/frame  gather ms  speedup  particles per strip" << std::endl;
+
+    double baseline = 0;
+    for (int processes = 1; processes <= MAX_PROCESSES; processes *= 2) {
+        int threads = std::max(1, HARDWARE_THREADS / processes);
+        domain::Coordinator coordinator(WIDTH, HEIGHT, positions, processes, SUBSTEPS, threads);
+
+        for (int i = 0; i < WARMUP_FRAMES; i++) {
+            coordinator.step(STEPTIME, false);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < FRAMES; i++) {
+            coordinator.step(STEPTIME, false);
+        }
+        double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() /
+                         FRAMES;
+
+        // One frame with positions gathered, minus a plain frame, is the assembly cost
+        start = std::chrono::steady_clock::now();
+        coordinator.step(STEPTIME, true);
+        double gatherMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() -
+                          frameMs;
+
+        if (processes == 1) baseline = frameMs;
+        std::cout << std::setw(9) << processes << std::setw(14) << threads
+                << std::setw(10) << std::fixed << std::setprecision(2) << frameMs
+                << std::setw(11) << std::max(0.0, gatherMs)
+                << std::setw(9) << baseline / frameMs << "  ";
+        for (int count: coordinator.getStripCounts()) {
+            std::cout << " " << count;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
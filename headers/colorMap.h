@@ -0,0 +1,28 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <array>
+
+namespace render {
+    enum class ColorMode {
+        Speed,
+        Pressure, // Particle count in the surrounding 3x3 grid cells
+        CellId
+    };
+
+    // Precomputed gradients so the per-frame colouring pass does no allocation or sqrt
+    class ColorMap {
+        static constexpr int LUT_SIZE = 256;
+
+        std::array<sf::Color, LUT_SIZE> speedLut;
+        std::array<sf::Color, LUT_SIZE> pressureLut;
+
+    public:
+        ColorMap();
+
+        sf::Color fromSpeedSq(float speedSq) const;
+
+        sf::Color fromNeighbourCount(int count) const;
+
+        sf::Color fromCellIndex(int cellIndex) const;
+    };
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// Splits one world into vertical strips, each simulated by its own forked process.
+// Workers trade migrating and ghost particles with their strip neighbours every
+// substep over Unix socket pairs; the coordinator only drives frames and gathers
+// positions for rendering or recording. POSIX only.
+namespace domain {
+    class Coordinator {
+        std::vector<pid_t> workers;
+        // One control socket per worker, owned by the coordinator side
+        std::vector<int> controls;
+        std::vector<sf::Vector2f> frame;
+        // Particles owned by each strip after the last step
+        std::vector<int> stripCounts;
+        int particleCount = 0;
+
+        void shutdown();
+
+    public:
+        Coordinator(int width, int height, int numParticles, int processCount, int substeps, int threadsPerProcess,
+                    const std::string &sceneFile = "");
+
+        // Starts from the given positions instead of the default spawn block
+        Coordinator(int width, int height, const std::vector<sf::Vector2f> &positions, int processCount, int substeps,
+                    int threadsPerProcess, const std::string &sceneFile = "");
+
+        ~Coordinator();
+
+        Coordinator(const Coordinator &) = delete;
+
+        Coordinator &operator=(const Coordinator &) = delete;
+
+        // Advances every strip by one frame, getFrame is refreshed only when wantFrame is set
+        void step(float dt, bool wantFrame);
+
+        const std::vector<sf::Vector2f> &getFrame() const;
+
+        int getParticleCount() const;
+
+        const std::vector<int> &getStripCounts() const;
+
+        int getProcessCount() const;
+    };
+}
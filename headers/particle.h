@@ -4,9 +4,9 @@
 namespace prtcl {
     class Particle {
     public:
-        const float radius = 5.0f;
+        static constexpr float radius = 5.0f;
 
-        const float restitution = 0.8f;
+        static constexpr float restitution = 0.8f;
         sf::Vector2f oldPosition;
         sf::Vector2f position;
         sf::Vector2f acceleration;
@@ -20,11 +20,13 @@ namespace prtcl {
 
         sf::Vector2f getVelocity() const;
 
+        // Accumulates until resetAcceleration, so a force applies to every substep of a frame
         void accelerate(const sf::Vector2f &force);
 
-        sf::Vector2f getPosition() const;
+        // Back to gravity only
+        void resetAcceleration();
 
-        void setColor();
+        sf::Vector2f getPosition() const;
 
         void draw(sf::RenderWindow &window);
     };
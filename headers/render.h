@@ -1,7 +1,19 @@
 #pragma once
+#include "colorMap.h"
 #include "simulation.h"
 
 namespace render {
+    // Static geometry doesn't move, its shapes are built once
+    class ObstacleShapes {
+        sf::VertexArray lines;
+        std::vector<sf::CircleShape> circles;
+
+    public:
+        explicit ObstacleShapes(const sim::StaticGeometry &geometry);
+
+        void draw(sf::RenderWindow &window) const;
+    };
+
     class Renderer {
         sf::RenderWindow &window;
 
@@ -13,11 +25,21 @@ namespace render {
         sf::Font font;
         sf::Clock mainClock;
 
+        ObstacleShapes obstacles;
+
+        ColorMap colorMap;
+        ColorMode colorMode = ColorMode::Speed;
+
         void countFPS();
 
+        // Copies positions into the shapes and colours them, once per displayed frame
+        void prepareParticles();
+
     public:
         Renderer(sf::RenderWindow &window, sim::Simulation &sim);
 
         void render();
+
+        void setColorMode(ColorMode mode);
     };
 }
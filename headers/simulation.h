@@ -2,8 +2,11 @@
 #define SIMULATION_H
 
 #include <SFML/Graphics.hpp>
+#include <functional>
 #include <vector>
 #include "particle.h"
+#include "staticGeometry.h"
+#include "telemetry.h"
 #include "threadpool.h"
 #include "uniformGrid.h"
 
@@ -11,31 +14,111 @@ namespace sim {
     class Simulation {
         int width, height;
         int substeps;
+        int minSubsteps, maxSubsteps;
         std::vector<prtcl::Particle> particles;
+        // Copies of particles owned by neighbouring domains, collided against but never integrated
+        std::vector<prtcl::Particle> ghosts;
+        // Owned strip of the world, the whole width unless running as a domain worker
+        float minX, maxX;
         int threadCount;
         std::vector<std::pair<int, int> > workDivisions;
         ThreadPool threadPool;
         UniformGrid grid;
+        StaticGeometry geometry;
+        telemetry::Metrics metrics;
+        float substepDt = 0;
+        // Mean penetration of touching pairs left after the last collision pass
+        float residualOverlap = 0;
+        // Coarsening hysteresis: calm frames in a row, frames left before a lowered count counts as enough,
+        // and the count that had to be raised again before that with the calm frames it now needs
+        int calmFrames = 0;
+        int probeFrames = 0;
+        int failedSubsteps = 0;
+        int failedDelay = 0;
+        std::function<void(Simulation &)> boundaryExchange;
 
     public:
         Simulation(int width, int height, int numParticles, int substeps, float dt);
 
+        // Only owns the strip [minX, maxX) of a width x height world, the grid gets a ghost margin on inner sides
+        Simulation(int width, int height, const std::vector<sf::Vector2f> &positions, int substeps, float minX,
+                   float maxX, int threads);
+
+        // Starting layout, a square block in the top left corner
+        static std::vector<sf::Vector2f> spawnPositions(int numParticles);
+
         void update(float dt);
 
+        // Lets update pick the substep count per frame within [min, max], equal bounds disable it
+        void setSubstepBounds(int min, int max);
+
+        int getSubsteps() const;
+
+        float getSubstepDt() const;
+
+        // Mouse forces act over the whole next frame
         void mousePull(sf::Vector2f pos);
 
         void mousePush(sf::Vector2f pos);
 
         std::vector<prtcl::Particle> &getParticle();
 
+        std::vector<prtcl::Particle> &getGhosts();
+
+        float getMinX() const;
+
+        float getMaxX() const;
+
+        // Called every substep between integration and the grid rebuild, used to trade
+        // migrating and ghost particles with neighbouring domains
+        void setBoundaryExchange(std::function<void(Simulation &)> exchange);
+
+        // On failure error describes the problem and the simulation runs without obstacles
+        bool loadScene(const std::string &path, std::string &error);
+
+        const StaticGeometry &getGeometry() const;
+
+        const UniformGrid &getGrid() const;
+
+        // Splits [0, count) into one contiguous range per thread and waits for all of them
+        void parallelFor(int count, const std::function<void(int, int)> &work);
+
+        // Particle-wide gauges are computed here, keep calls out of the per-frame path
+        telemetry::Snapshot collectMetrics();
+
     private:
+        struct RangeStats {
+            float overlapSum = 0;
+            int contacts = 0;
+        };
+
+        // Overlap measured by each task slot after the last substep
+        std::vector<RangeStats> slotStats;
+
         void resolveWallCollisions(prtcl::Particle &p);
 
         void resolveParticleCollision(prtcl::Particle &p1, prtcl::Particle &p2);
 
         void processCollisions();
 
-        void processGridRange(int startIdx, int endIdx);
+        // Visits the pairs of cell (x, y) and of its right, bottom and bottom diagonal neighbours
+        template<class F>
+        void forEachCellPair(int x, int y, F &&visit);
+
+        // Returns the most particles found in one cell of the range
+        int processGridRange(int startIdx, int endIdx);
+
+        // Read only pass, overlap that remains once collisions are resolved
+        RangeStats measureGridRange(int startIdx, int endIdx);
+
+        void measureResidualOverlap();
+
+        void chooseSubsteps(float dt);
+
+        void setSubsteps(int count);
+
+        // Same as parallelFor, work also receives the index of its task slot
+        void parallelForSlots(int count, const std::function<void(int, int, int)> &work);
     };
 }
 
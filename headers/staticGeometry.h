@@ -0,0 +1,60 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <string>
+#include <vector>
+#include "particle.h"
+#include "uniformGrid.h"
+
+namespace sim {
+    struct Segment {
+        sf::Vector2f a;
+        sf::Vector2f b;
+        // Side particles are kept on, as the sign of cross(b - a, p - a). Polygon edges use their outer
+        // side, free segments (0) keep each particle on the side it came from
+        int side = 0;
+    };
+
+    struct CircleObstacle {
+        sf::Vector2f center;
+        float radius;
+    };
+
+    // Immovable colliders (walls, funnels, pegs...). Shapes are baked into per-cell
+    // index lists laid out like UniformGrid::cells, so a particle only tests the
+    // shapes that touch its own cell.
+    class StaticGeometry {
+        std::vector<Segment> segments;
+        std::vector<CircleObstacle> circles;
+
+        std::vector<std::vector<int> > segmentCells;
+        std::vector<std::vector<int> > circleCells;
+
+    public:
+        void addSegment(const sf::Vector2f &a, const sf::Vector2f &b);
+
+        // Closed outline, the last point is joined back to the first
+        void addPolygon(const std::vector<sf::Vector2f> &points);
+
+        void addCircle(const sf::Vector2f &center, float radius);
+
+        // Text scene format, one shape per line, '#' starts a comment:
+        //   segment x1 y1 x2 y2
+        //   polygon x1 y1 x2 y2 x3 y3 ...
+        //   circle cx cy r          (r > 0)
+        // Returns false and leaves the shapes untouched if the file is missing or has a bad line
+        bool loadFromFile(const std::string &path, std::string &error);
+
+        void clear();
+
+        // Must be called after shapes change, margin is the largest particle radius
+        void bake(const UniformGrid &grid, float margin);
+
+        void resolveCollisions(prtcl::Particle &p, int cellIndex) const;
+
+        bool hasShapesInCell(int cellIndex) const;
+
+        const std::vector<Segment> &getSegments() const;
+
+        const std::vector<CircleObstacle> &getCircles() const;
+    };
+}
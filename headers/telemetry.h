@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace telemetry {
+    // Bucket i counts substeps that took less than 2^i microseconds, the last one is +Inf
+    constexpr int LATENCY_BUCKETS = 17;
+
+    // Counters written by a single thread pool task slot. Padded to a cache line so
+    // tasks running side by side never contend, relaxed atomics keep the reads safe.
+    struct alignas(64) SlotCounters {
+        std::atomic<uint64_t> busyNs{0};
+        std::atomic<int> maxCellOccupancy{0};
+
+        void addBusy(uint64_t ns);
+
+        void observeCellOccupancy(int occupancy);
+    };
+
+    struct Snapshot {
+        std::array<uint64_t, LATENCY_BUCKETS> latencyBuckets{};
+        uint64_t latencySumNs = 0;
+        uint64_t substepCount = 0;
+        int substeps = 0;
+        int particleCount = 0;
+        int maxCellOccupancy = 0;
+        int escapedParticles = 0;
+        double kineticEnergy = 0;
+        double threadUtilisation = 0;
+    };
+
+    class Metrics {
+        std::array<std::atomic<uint64_t>, LATENCY_BUCKETS> latencyBuckets{};
+        std::atomic<uint64_t> latencySumNs{0};
+        std::atomic<uint64_t> substepCount{0};
+        std::atomic<uint64_t> parallelWallNs{0};
+        std::vector<SlotCounters> slots;
+
+    public:
+        explicit Metrics(int slotCount);
+
+        void recordSubstep(uint64_t ns);
+
+        void recordParallelSection(uint64_t wallNs);
+
+        SlotCounters &slot(int index);
+
+        // Latency histogram is cumulative, occupancy and utilisation cover the time since the last collect
+        void collect(Snapshot &out);
+    };
+
+    inline uint64_t elapsedNs(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    // Writes snapshots to a local file. Paths ending in ".prom" get the Prometheus text
+    // format (rewritten each time, for node_exporter's textfile collector), anything
+    // else gets one JSON object appended per line.
+    class Exporter {
+        std::string path;
+        bool prometheus;
+        std::chrono::duration<float> interval;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point lastWrite;
+
+        // time is in seconds since the exporter was created
+        bool writeJsonLine(const Snapshot &s, double time) const;
+
+        bool writePrometheus(const Snapshot &s) const;
+
+    public:
+        Exporter(const std::string &path, float intervalSeconds);
+
+        bool due() const;
+
+        // Returns false if the file couldn't be written
+        bool write(const Snapshot &s);
+    };
+}
@@ -1,3 +1,4 @@
+#pragma once
 #include <functional>
 #include "particle.h"
 
@@ -5,15 +6,18 @@ class UniformGrid {
 public:
     int cellSize;
     int gridWidth, gridHeight;
+    // World x of the grid's left edge, non zero when the grid only covers a strip of the world
+    float originX = 0;
     std::vector<std::vector<prtcl::Particle *> > cells;
 
     UniformGrid() {
     }
 
-    UniformGrid(int width, int height, int cellSize)
+    UniformGrid(int width, int height, int cellSize, float originX = 0)
         : cellSize(cellSize),
           gridWidth(width / cellSize + 1),
-          gridHeight(height / cellSize + 1) {
+          gridHeight(height / cellSize + 1),
+          originX(originX) {
         cells.resize(gridWidth * gridHeight);
     }
 
@@ -24,7 +28,7 @@ public:
     }
 
     int getCellIndex(const sf::Vector2f &position) const {
-        int cellX = static_cast<int>(position.x / cellSize);
+        int cellX = static_cast<int>((position.x - originX) / cellSize);
         int cellY = static_cast<int>(position.y / cellSize);
 
         cellX = std::max(0, std::min(cellX, gridWidth - 1));
@@ -1,16 +1,87 @@
 #include <omp.h>
 #include <thread>
+#include <iostream>
+#include <string>
 
 #include "headers/simulation.h"
 #include "headers/render.h"
+#ifndef _WIN32
+#include "headers/domain.h"
 
-int main() {
+// World split in strips over several processes, no mouse interaction or colour modes.
+// processCount must be at least 1
+static int runDomain(int processCount, int width, int height, int numParticles, int substeps, float dt,
+                     int framerate, const std::string &sceneFile) {
+    // Workers are forked before the window exists so they don't inherit its threads
+    int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / processCount);
+    // The scene is checked here so a bad file is reported once, workers only get it if it loads
+    sim::StaticGeometry geometry;
+    std::string sceneError;
+    bool sceneLoaded = geometry.loadFromFile(sceneFile, sceneError);
+    if (!sceneLoaded) {
+        std::cout << sceneError << ", running without obstacles" << std::endl;
+    }
+    domain::Coordinator coordinator(width, height, numParticles, processCount, substeps, threads,
+                                    sceneLoaded ? sceneFile : "");
+    render::ObstacleShapes obstacles(geometry);
+
+    sf::RenderWindow window(sf::VideoMode(width, height), "Particle simulation", sf::Style::Default,
+                            sf::ContextSettings());
+    window.setFramerateLimit(framerate);
+
+    sf::CircleShape shape(prtcl::Particle::radius);
+    while (window.isOpen()) {
+        sf::Event event;
+        while (window.pollEvent(event)) {
+            if (event.type == sf::Event::Closed)
+                window.close();
+        }
+
+        coordinator.step(dt, true);
+
+        window.clear();
+        for (auto &pos: coordinator.getFrame()) {
+            shape.setPosition(pos);
+            window.draw(shape);
+        }
+        obstacles.draw(window);
+        window.display();
+    }
+    return 0;
+}
+#endif
+
+int main(int argc, char **argv) {
     const int WIDTH = 1920;
     const int HEIGHT = 1080;
     const int NUM_PARTICLES = 10000;
     const float STEPTIME = 1.f / 60.f;
     const int SUBSTEPS = 8;
+    const int MIN_SUBSTEPS = 2;
+    const int MAX_SUBSTEPS = 16;
     const int FRAMERATE = 60;
+    const std::string SCENE_FILE = "obstacles.scene";
+    // Use a ".prom" extension for Prometheus text format instead of JSON lines
+    const std::string METRICS_FILE = "metrics.jsonl";
+    const float METRICS_INTERVAL = 5.f;
+
+#ifndef _WIN32
+    // verletIntegration --processes N
+    if (argc > 1 && std::string(argv[1]) == "--processes") {
+        int processCount = 0;
+        size_t parsed = 0;
+        try {
+            if (argc == 3) processCount = std::stoi(argv[2], &parsed);
+        } catch (const std::exception &) {
+            processCount = 0;
+        }
+        if (argc != 3 || argv[2][parsed] != '\0' || processCount < 1) {
+            std::cout << "usage: " << argv[0] << " [--processes N], N >= 1" << std::endl;
+            return 1;
+        }
+        return runDomain(processCount, WIDTH, HEIGHT, NUM_PARTICLES, SUBSTEPS, STEPTIME, FRAMERATE, SCENE_FILE);
+    }
+#endif
 
     sf::ContextSettings settings;
     settings.antialiasingLevel = 1;
@@ -19,14 +90,28 @@ int main() {
     window.setFramerateLimit(FRAMERATE);
 
     sim::Simulation sim = sim::Simulation(WIDTH, HEIGHT, NUM_PARTICLES, SUBSTEPS, STEPTIME);
+    sim.setSubstepBounds(MIN_SUBSTEPS, MAX_SUBSTEPS);
+    std::string sceneError;
+    if (!sim.loadScene(SCENE_FILE, sceneError)) {
+        std::cout << sceneError << ", running without obstacles" << std::endl;
+    }
 
     render::Renderer r = render::Renderer(window, sim);
 
+    telemetry::Exporter metricsExporter(METRICS_FILE, METRICS_INTERVAL);
+
     while (window.isOpen()) {
         sf::Event event;
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed)
                 window.close();
+
+            // Colour modes, useful to diagnose the solver
+            if (event.type == sf::Event::KeyPressed) {
+                if (event.key.code == sf::Keyboard::Num1) r.setColorMode(render::ColorMode::Speed);
+                if (event.key.code == sf::Keyboard::Num2) r.setColorMode(render::ColorMode::Pressure);
+                if (event.key.code == sf::Keyboard::Num3) r.setColorMode(render::ColorMode::CellId);
+            }
         }
 
         if (sf::Mouse::isButtonPressed(sf::Mouse::Left)) {
@@ -41,6 +126,10 @@ int main() {
 
         sim.update(STEPTIME);
         r.render();
+
+        if (metricsExporter.due() && !metricsExporter.write(sim.collectMetrics())) {
+            std::cout << "Failed to write metrics to " << METRICS_FILE << std::endl;
+        }
     }
     return 0;
 }
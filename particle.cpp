@@ -1,17 +1,10 @@
 #include "headers/particle.h"
-#include <cmath>
-#include <iostream>
-#include <vector>
 
 namespace prtcl {
-    // Used only for coloring
-    constexpr float MIN_SPEED = 0.0f;
-    constexpr float MAX_SPEED = 7.0f;
-
     Particle::Particle(float x, float y) {
         position = {x, y};
         oldPosition = position;
-        acceleration = {0.0f, 0.0f};
+        resetAcceleration();
         shape.setRadius(radius);
         shape.setPosition(position);
     }
@@ -29,9 +22,6 @@ namespace prtcl {
         //     velocity = velocity * (20.f / speed);
         //     setVelocity(velocity);
         // }
-        acceleration = {0.f, 1000.f};
-        shape.setPosition(position);
-        shape.setFillColor(sf::Color::White);
     }
 
     sf::Vector2f Particle::getVelocity() const {
@@ -46,42 +36,11 @@ namespace prtcl {
         acceleration += force;
     }
 
-    sf::Vector2f Particle::getPosition() const {
-        return position;
+    void Particle::resetAcceleration() {
+        acceleration = {0.f, 1000.f};
     }
 
-    void Particle::setColor() {
-        sf::Vector2f vel = getVelocity();
-        float speed = std::sqrt(vel.x * vel.x + vel.y * vel.y);
-
-        // Normalize speed to [0, 1] range
-        float normalizedSpeed = std::clamp((speed - MIN_SPEED) / (MAX_SPEED - MIN_SPEED), 0.0f, 1.0f);
-
-        // Color gradient from cold (blue) to hot (red)
-        const std::vector colors = {
-            sf::Color(0, 0, 255), // Blue (cold)
-            sf::Color(0, 255, 255), // Cyan
-            sf::Color(0, 255, 0), // Green
-            sf::Color(255, 255, 0), // Yellow
-            sf::Color(255, 0, 0) // Red (hot)
-        };
-
-        // Interpolate between colors
-        float colorIndex = normalizedSpeed * (colors.size() - 1);
-        int index1 = static_cast<int>(colorIndex);
-        int index2 = std::min(index1 + 1, static_cast<int>(colors.size() - 1));
-        float t = colorIndex - index1;
-
-        // Fixes particles going out of the window and crashing the sim due to segfault
-        if (position.x > 0 && position.y > 0 && position.x < 1920 && position.y < 1080) {
-            sf::Color color;
-            color.r = static_cast<sf::Uint8>(colors[index1].r + t * (colors[index2].r - colors[index1].r));
-            color.g = static_cast<sf::Uint8>(colors[index1].g + t * (colors[index2].g - colors[index1].g));
-            color.b = static_cast<sf::Uint8>(colors[index1].b + t * (colors[index2].b - colors[index1].b));
-            shape.setFillColor(color);
-        } else {
-            shape.setFillColor(sf::Color::White);
-            //std::cout << "out of window" << std::endl;
-        }
+    sf::Vector2f Particle::getPosition() const {
+        return position;
     }
 }
@@ -4,8 +4,33 @@
 #include <sstream>
 
 namespace render {
+    ObstacleShapes::ObstacleShapes(const sim::StaticGeometry &geometry)
+        : lines(sf::Lines) {
+        const sf::Color obstacleColor(160, 160, 160);
+
+        for (const auto &s: geometry.getSegments()) {
+            lines.append(sf::Vertex(s.a, obstacleColor));
+            lines.append(sf::Vertex(s.b, obstacleColor));
+        }
+
+        for (const auto &c: geometry.getCircles()) {
+            sf::CircleShape shape(c.radius);
+            shape.setOrigin(c.radius, c.radius);
+            shape.setPosition(c.center);
+            shape.setFillColor(obstacleColor);
+            circles.push_back(shape);
+        }
+    }
+
+    void ObstacleShapes::draw(sf::RenderWindow &window) const {
+        window.draw(lines);
+        for (auto &c: circles) {
+            window.draw(c);
+        }
+    }
+
     Renderer::Renderer(sf::RenderWindow &window, sim::Simulation &sim)
-        : window(window), sim(sim) {
+        : window(window), sim(sim), obstacles(sim.getGeometry()) {
         if (!font.loadFromFile("Roboto-VariableFont_wdth,wght.ttf")) {
             throw std::runtime_error("Failed to load font");
         }
@@ -16,13 +41,58 @@ namespace render {
         fpsText.setPosition(10, 10);
     }
 
+    void Renderer::setColorMode(ColorMode mode) {
+        colorMode = mode;
+    }
+
+    void Renderer::prepareParticles() {
+        std::vector<prtcl::Particle> &particles = sim.getParticle();
+        const UniformGrid &grid = sim.getGrid();
+        // Substep length changes from frame to frame, colour by speed per second
+        const float invDt = sim.getSubstepDt() > 0 ? 1.0f / sim.getSubstepDt() : 0.0f;
+
+        sim.parallelFor(static_cast<int>(particles.size()), [&](int startIdx, int endIdx) {
+            for (int i = startIdx; i < endIdx; i++) {
+                prtcl::Particle &p = particles[i];
+                p.shape.setPosition(p.position);
+
+                switch (colorMode) {
+                    case ColorMode::Speed: {
+                        sf::Vector2f vel = p.getVelocity() * invDt;
+                        p.shape.setFillColor(colorMap.fromSpeedSq(vel.x * vel.x + vel.y * vel.y));
+                        break;
+                    }
+                    case ColorMode::Pressure: {
+                        int cellIndex = grid.getCellIndex(p.position);
+                        int cx = cellIndex % grid.gridWidth;
+                        int cy = cellIndex / grid.gridWidth;
+                        int count = 0;
+                        for (int y = std::max(0, cy - 1); y <= std::min(grid.gridHeight - 1, cy + 1); y++) {
+                            for (int x = std::max(0, cx - 1); x <= std::min(grid.gridWidth - 1, cx + 1); x++) {
+                                count += static_cast<int>(grid.cells[y * grid.gridWidth + x].size());
+                            }
+                        }
+                        // Don't count the particle itself
+                        p.shape.setFillColor(colorMap.fromNeighbourCount(count - 1));
+                        break;
+                    }
+                    case ColorMode::CellId:
+                        p.shape.setFillColor(colorMap.fromCellIndex(grid.getCellIndex(p.position)));
+                        break;
+                }
+            }
+        });
+    }
+
     void Renderer::render() {
         countFPS();
+        prepareParticles();
         window.clear();
         //sim.tree.draw(window);
         for (auto &p: sim.getParticle()) {
             window.draw(p.shape);
         }
+        obstacles.draw(window);
         window.draw(fpsText);
         window.display();
     }
@@ -34,7 +104,7 @@ namespace render {
         std::ostringstream fpsStream;
         fpsText.setString(
             std::to_string(fps) + "fps, " + std::to_string(ms) + "ms, " + std::to_string(sim.getParticle().size()) +
-            " particles");
+            " particles, " + std::to_string(sim.getSubsteps()) + " substeps");
         fpsClock.restart();
     }
 }
@@ -1,23 +1,60 @@
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <future>
 #include "headers/simulation.h"
 
 namespace sim {
     int cellSize = 12;
+    // Gap kept between the outer walls and the window border
+    const float wallPadding = 10.0f;
+    // Adaptive substeps: largest per-substep move allowed, as a fraction of the particle radius
+    const float maxDisplacementRatio = 1.0f;
+    // Adaptive substeps: mean penetration still left after the collision pass that triggers an extra substep,
+    // fraction of the radius. Removing a substep needs half of it, so the count doesn't flip every frame
+    const float overlapTolerance = 0.06f;
+    // Adaptive substeps: calm frames in a row needed before dropping a substep. Extra overlap from a lower
+    // count takes a few frames to build up, a count that fails that way waits twice as long each time
+    const int coarsenDelay = 20;
+    const int maxCoarsenDelay = 640;
 
     Simulation::Simulation(int width, int height, int numParticles, int substeps, float dt)
+        : Simulation(width, height, spawnPositions(numParticles), substeps, 0.0f, static_cast<float>(width),
+                     static_cast<int>(std::thread::hardware_concurrency())) {
+    }
+
+    Simulation::Simulation(int width, int height, const std::vector<sf::Vector2f> &positions, int substeps,
+                           float minX, float maxX, int threads)
         : width(width),
           height(height),
           substeps(substeps),
-          grid(UniformGrid(width, height, cellSize)),
-          threadPool(std::thread::hardware_concurrency()) {
-        particles.reserve(numParticles);
-
-        threadCount = std::thread::hardware_concurrency();
+          minSubsteps(substeps),
+          maxSubsteps(substeps),
+          minX(minX),
+          maxX(maxX),
+          threadPool(threads),
+          metrics(threads) {
+        // Inner strip edges get one extra cell column to hold ghosts
+        float gridMinX = minX > 0 ? minX - cellSize : 0.0f;
+        float gridMaxX = maxX < width ? maxX + cellSize : static_cast<float>(width);
+        grid = UniformGrid(static_cast<int>(std::ceil(gridMaxX - gridMinX)), height, cellSize, gridMinX);
+
+        particles.reserve(positions.size());
+
+        threadCount = threads;
+        slotStats.resize(threadCount);
 
         // Initialize work divisions for threads
         workDivisions.resize(threadCount);
 
+        for (auto coords: positions) {
+            particles.emplace_back(coords.x, coords.y);
+        }
+
+        geometry.bake(grid, prtcl::Particle::radius);
+    }
+
+    std::vector<sf::Vector2f> Simulation::spawnPositions(int numParticles) {
         // Spawn particles in grid pattern
         std::vector<sf::Vector2f> predefinedPositions;
         int gridSize = std::ceil(std::sqrt(numParticles));
@@ -31,9 +68,14 @@ namespace sim {
             }
         }
 
-        for (auto coords: predefinedPositions) {
-            particles.emplace_back(coords.x, coords.y);
-        }
+        return predefinedPositions;
+    }
+
+    bool Simulation::loadScene(const std::string &path, std::string &error) {
+        geometry.clear();
+        bool loaded = geometry.loadFromFile(path, error);
+        geometry.bake(grid, prtcl::Particle::radius);
+        return loaded;
     }
 
     void Simulation::mousePull(sf::Vector2f pos) {
@@ -42,7 +84,7 @@ namespace sim {
             sf::Vector2f diff = pos - obj.position;
             float distSq = diff.x * diff.x + diff.y * diff.y;
             if (distSq > PULL_RADIUS_SQ) continue;
-            obj.accelerate(diff * 100.f);
+            obj.accelerate(diff * 12.5f);
         }
     }
 
@@ -52,7 +94,7 @@ namespace sim {
             sf::Vector2f diff = pos - obj.position;
             float distSq = diff.x * diff.x + diff.y * diff.y;
             if (distSq > PULL_RADIUS_SQ) continue;
-            obj.accelerate(-diff * 10000.f);
+            obj.accelerate(-diff * 1250.f);
         }
     }
 
@@ -60,7 +102,7 @@ namespace sim {
         sf::Vector2f vel = p.getVelocity();
         const float radius = p.radius;
         const float restitution = p.restitution;
-        const int padding = 10;
+        const float padding = wallPadding;
         // Left wall
         if (p.position.x < radius) {
             p.position.x = radius;
@@ -123,86 +165,127 @@ namespace sim {
         }
     }
 
-    void Simulation::processGridRange(int startIdx, int endIdx) {
-        for (int idx = startIdx; idx < endIdx; idx++) {
-            // Get y and x from linear index
-            int y = idx / grid.gridWidth;
-            int x = idx % grid.gridWidth;
+    template<class F>
+    void Simulation::forEachCellPair(int x, int y, F &&visit) {
+        std::vector<prtcl::Particle *> &currentCell = grid.cells[y * grid.gridWidth + x];
 
-            int cellIndex = y * grid.gridWidth + x;
-            std::vector<prtcl::Particle *> &currentCell = grid.cells[cellIndex];
+        // Process current cell
+        for (size_t i = 0; i < currentCell.size(); i++) {
+            for (size_t j = i + 1; j < currentCell.size(); j++) {
+                visit(*currentCell[i], *currentCell[j]);
+            }
+        }
 
-            // Process current cell
-            for (size_t i = 0; i < currentCell.size(); i++) {
-                for (size_t j = i + 1; j < currentCell.size(); j++) {
-                    resolveParticleCollision(*currentCell[i], *currentCell[j]);
+        // Check right neighbor
+        if (x < grid.gridWidth - 1) {
+            int rightIndex = y * grid.gridWidth + (x + 1);
+            for (auto p1: currentCell) {
+                for (auto p2: grid.cells[rightIndex]) {
+                    visit(*p1, *p2);
                 }
             }
+        }
 
-            // Check right neighbor
-            if (x < grid.gridWidth - 1) {
-                int rightIndex = y * grid.gridWidth + (x + 1);
-                for (auto p1: currentCell) {
-                    for (auto p2: grid.cells[rightIndex]) {
-                        resolveParticleCollision(*p1, *p2);
-                    }
+        // Check bottom neighbor
+        if (y < grid.gridHeight - 1) {
+            int bottomIndex = (y + 1) * grid.gridWidth + x;
+            for (auto p1: currentCell) {
+                for (auto p2: grid.cells[bottomIndex]) {
+                    visit(*p1, *p2);
                 }
             }
+        }
 
-            // Check bottom neighbor
-            if (y < grid.gridHeight - 1) {
-                int bottomIndex = (y + 1) * grid.gridWidth + x;
-                for (auto p1: currentCell) {
-                    for (auto p2: grid.cells[bottomIndex]) {
-                        resolveParticleCollision(*p1, *p2);
-                    }
+        // Check bottom-right neighbor
+        if (x < grid.gridWidth - 1 && y < grid.gridHeight - 1) {
+            int bottomRightIndex = (y + 1) * grid.gridWidth + (x + 1);
+            for (auto p1: currentCell) {
+                for (auto p2: grid.cells[bottomRightIndex]) {
+                    visit(*p1, *p2);
                 }
             }
+        }
 
-            // Check bottom-right neighbor
-            if (x < grid.gridWidth - 1 && y < grid.gridHeight - 1) {
-                int bottomRightIndex = (y + 1) * grid.gridWidth + (x + 1);
-                for (auto p1: currentCell) {
-                    for (auto p2: grid.cells[bottomRightIndex]) {
-                        resolveParticleCollision(*p1, *p2);
-                    }
+        // Check bottom-left neighbor
+        if (x > 0 && y < grid.gridHeight - 1) {
+            int bottomLeftIndex = (y + 1) * grid.gridWidth + (x - 1);
+            for (auto p1: currentCell) {
+                for (auto p2: grid.cells[bottomLeftIndex]) {
+                    visit(*p1, *p2);
                 }
             }
+        }
+    }
 
-            // Check bottom-left neighbor
-            if (x > 0 && y < grid.gridHeight - 1) {
-                int bottomLeftIndex = (y + 1) * grid.gridWidth + (x - 1);
-                for (auto p1: currentCell) {
-                    for (auto p2: grid.cells[bottomLeftIndex]) {
-                        resolveParticleCollision(*p1, *p2);
-                    }
+    int Simulation::processGridRange(int startIdx, int endIdx) {
+        size_t maxOccupancy = 0;
+        auto collide = [this](prtcl::Particle &p1, prtcl::Particle &p2) {
+            resolveParticleCollision(p1, p2);
+        };
+        for (int idx = startIdx; idx < endIdx; idx++) {
+            // Get y and x from linear index
+            int y = idx / grid.gridWidth;
+            int x = idx % grid.gridWidth;
+
+            int cellIndex = y * grid.gridWidth + x;
+            std::vector<prtcl::Particle *> &currentCell = grid.cells[cellIndex];
+            maxOccupancy = std::max(maxOccupancy, currentCell.size());
+
+            // Static geometry touching this cell
+            if (geometry.hasShapesInCell(cellIndex)) {
+                for (auto p: currentCell) {
+                    geometry.resolveCollisions(*p, cellIndex);
                 }
             }
+
+            forEachCellPair(x, y, collide);
         }
+        return static_cast<int>(maxOccupancy);
     }
 
-    void Simulation::processCollisions() {
-        int totalCells = grid.gridWidth * grid.gridHeight;
-        int cellsPerThread = totalCells / threadCount;
-        int remainingCells = totalCells % threadCount;
+    Simulation::RangeStats Simulation::measureGridRange(int startIdx, int endIdx) {
+        RangeStats stats;
+        const float minDist = 2 * prtcl::Particle::radius;
+        auto measure = [&stats, minDist](prtcl::Particle &p1, prtcl::Particle &p2) {
+            sf::Vector2f diff = p2.position - p1.position;
+            float distSq = diff.x * diff.x + diff.y * diff.y;
+            if (distSq >= minDist * minDist) return;
+            stats.overlapSum += minDist - std::sqrt(distSq);
+            stats.contacts++;
+        };
+        for (int idx = startIdx; idx < endIdx; idx++) {
+            forEachCellPair(idx % grid.gridWidth, idx / grid.gridWidth, measure);
+        }
+        return stats;
+    }
+
+    void Simulation::parallelFor(int count, const std::function<void(int, int)> &work) {
+        parallelForSlots(count, [&work](int, int startIdx, int endIdx) {
+            work(startIdx, endIdx);
+        });
+    }
+
+    void Simulation::parallelForSlots(int count, const std::function<void(int, int, int)> &work) {
+        int itemsPerThread = count / threadCount;
+        int remainingItems = count % threadCount;
 
         std::vector<std::future<void> > futures;
 
-        // Distribute cells among threads
-        int currentCell = 0;
+        // Distribute items among threads
+        int currentItem = 0;
         for (int i = 0; i < threadCount; i++) {
-            int cellsForThisThread = cellsPerThread + (i < remainingCells ? 1 : 0);
-            int startIdx = currentCell;
-            int endIdx = startIdx + cellsForThisThread;
+            int itemsForThisThread = itemsPerThread + (i < remainingItems ? 1 : 0);
+            int startIdx = currentItem;
+            int endIdx = startIdx + itemsForThisThread;
 
             // Submit task to thread pool
             futures.push_back(
-                threadPool.enqueue([this, startIdx, endIdx]() {
-                    this->processGridRange(startIdx, endIdx);
+                threadPool.enqueue([&work, i, startIdx, endIdx]() {
+                    work(i, startIdx, endIdx);
                 })
             );
 
-            currentCell = endIdx;
+            currentItem = endIdx;
         }
 
         for (auto &future: futures) {
@@ -210,23 +293,204 @@ namespace sim {
         }
     }
 
+    void Simulation::measureResidualOverlap() {
+        parallelForSlots(grid.gridWidth * grid.gridHeight, [this](int slot, int startIdx, int endIdx) {
+            slotStats[slot] = this->measureGridRange(startIdx, endIdx);
+        });
+
+        float overlapSum = 0.0f;
+        int contacts = 0;
+        for (const auto &stats: slotStats) {
+            overlapSum += stats.overlapSum;
+            contacts += stats.contacts;
+        }
+        residualOverlap = contacts > 0 ? overlapSum / contacts : 0.0f;
+    }
+
+    void Simulation::processCollisions() {
+        // Only the collision pass feeds thread utilisation, other parallelFor users (render prep) stay out of it
+        auto sectionStart = std::chrono::steady_clock::now();
+        parallelForSlots(grid.gridWidth * grid.gridHeight, [this](int slot, int startIdx, int endIdx) {
+            auto taskStart = std::chrono::steady_clock::now();
+            metrics.slot(slot).observeCellOccupancy(this->processGridRange(startIdx, endIdx));
+            metrics.slot(slot).addBusy(telemetry::elapsedNs(taskStart));
+        });
+        metrics.recordParallelSection(telemetry::elapsedNs(sectionStart));
+    }
+
+    void Simulation::setSubstepBounds(int min, int max) {
+        minSubsteps = std::max(1, min);
+        maxSubsteps = std::max(minSubsteps, max);
+    }
+
+    void Simulation::setSubsteps(int count) {
+        if (count == substeps) return;
+        // Rescale Verlet velocities to the new step length
+        float scale = static_cast<float>(substeps) / count;
+        for (auto &p: particles) {
+            p.setVelocity(p.getVelocity() * scale);
+        }
+        substeps = count;
+    }
+
+    int Simulation::getSubsteps() const {
+        return substeps;
+    }
+
+    float Simulation::getSubstepDt() const {
+        return substepDt;
+    }
+
+    void Simulation::chooseSubsteps(float dt) {
+        if (minSubsteps == maxSubsteps) {
+            setSubsteps(minSubsteps);
+            return;
+        }
+
+        // Velocities are stored as displacement per substep, bring them back to per frame
+        float maxSpeedSq = 0.0f;
+        float maxAccelSq = 0.0f;
+        for (auto &p: particles) {
+            sf::Vector2f vel = p.getVelocity();
+            maxSpeedSq = std::max(maxSpeedSq, vel.x * vel.x + vel.y * vel.y);
+            maxAccelSq = std::max(maxAccelSq, p.acceleration.x * p.acceleration.x + p.acceleration.y * p.acceleration.y);
+        }
+        float frameDisplacement = std::sqrt(maxSpeedSq) * substeps;
+        float maxAccel = std::sqrt(maxAccelSq);
+        const float allowed = maxDisplacementRatio * prtcl::Particle::radius;
+
+        // Smallest count keeping one substep's move under the limit. External forces act on every
+        // substep of the frame, so the impulse they give doesn't depend on the count picked here
+        int wanted = minSubsteps;
+        while (wanted < maxSubsteps) {
+            float h = dt / wanted;
+            if (frameDisplacement / wanted + maxAccel * h * h <= allowed) break;
+            wanted++;
+        }
+
+        // Collisions couldn't separate the particles last frame, refine further
+        const float tolerance = overlapTolerance * prtcl::Particle::radius;
+        if (residualOverlap > tolerance) {
+            wanted = std::max(wanted, substeps + 1);
+        } else if (residualOverlap > tolerance * 0.5f) {
+            wanted = std::max(wanted, substeps);
+        }
+        wanted = std::clamp(wanted, minSubsteps, maxSubsteps);
+
+        // Calm frames needed before leaving the given count for the one below
+        auto delayBelow = [this](int count) {
+            return count - 1 <= failedSubsteps ? failedDelay : coarsenDelay;
+        };
+
+        if (probeFrames > 0) probeFrames--;
+        if (wanted > substeps) {
+            // Raised again soon after coming down, the lower count wasn't enough
+            if (probeFrames > 0) {
+                failedDelay = std::min(delayBelow(substeps + 1) * 2, maxCoarsenDelay);
+                failedSubsteps = substeps;
+                probeFrames = 0;
+            }
+            calmFrames = 0;
+        } else if (wanted < substeps) {
+            calmFrames++;
+        } else {
+            calmFrames = 0;
+        }
+
+        // Only coarsen one step at a time, once the scene stayed calm long enough
+        if (wanted < substeps) {
+            if (calmFrames < delayBelow(substeps)) {
+                wanted = substeps;
+            } else {
+                probeFrames = delayBelow(substeps);
+                wanted = substeps - 1;
+                calmFrames = 0;
+            }
+        }
+
+        setSubsteps(wanted);
+    }
+
     void Simulation::update(float dt) {
+        chooseSubsteps(dt);
+        substepDt = dt / substeps;
         for (int step = 0; step < substeps; step++) {
+            auto substepStart = std::chrono::steady_clock::now();
             for (auto &p: particles) {
                 p.update(dt / substeps);
                 resolveWallCollisions(p);
             }
 
+            if (boundaryExchange) {
+                boundaryExchange(*this);
+            }
+
             grid.clear();
             for (auto &p: particles) {
                 grid.insert(&p);
             }
+            for (auto &p: ghosts) {
+                grid.insert(&p);
+            }
 
             processCollisions();
+            metrics.recordSubstep(telemetry::elapsedNs(substepStart));
+        }
+
+        // Overlap left after the final collision pass drives next frame's refinement
+        if (minSubsteps != maxSubsteps) {
+            measureResidualOverlap();
+        }
+
+        // External forces last one frame
+        for (auto &p: particles) {
+            p.resetAcceleration();
+        }
+    }
+
+    telemetry::Snapshot Simulation::collectMetrics() {
+        telemetry::Snapshot snapshot;
+        metrics.collect(snapshot);
+        snapshot.substeps = substeps;
+        snapshot.particleCount = static_cast<int>(particles.size());
+
+        for (auto &p: particles) {
+            if (p.position.x < 0 || p.position.y < 0 || p.position.x > width || p.position.y > height) {
+                snapshot.escapedParticles++;
+            }
+            if (substepDt > 0) {
+                sf::Vector2f vel = p.getVelocity() / substepDt;
+                snapshot.kineticEnergy += 0.5 * (vel.x * vel.x + vel.y * vel.y);
+            }
         }
+        return snapshot;
     }
 
     std::vector<prtcl::Particle> &Simulation::getParticle() {
         return particles;
     }
+
+    std::vector<prtcl::Particle> &Simulation::getGhosts() {
+        return ghosts;
+    }
+
+    float Simulation::getMinX() const {
+        return minX;
+    }
+
+    float Simulation::getMaxX() const {
+        return maxX;
+    }
+
+    void Simulation::setBoundaryExchange(std::function<void(Simulation &)> exchange) {
+        boundaryExchange = std::move(exchange);
+    }
+
+    const StaticGeometry &Simulation::getGeometry() const {
+        return geometry;
+    }
+
+    const UniformGrid &Simulation::getGrid() const {
+        return grid;
+    }
 }
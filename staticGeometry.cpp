@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include "headers/staticGeometry.h"
+
+namespace sim {
+    static float dot(const sf::Vector2f &a, const sf::Vector2f &b) {
+        return a.x * b.x + a.y * b.y;
+    }
+
+    static float cross(const sf::Vector2f &a, const sf::Vector2f &b) {
+        return a.x * b.y - a.y * b.x;
+    }
+
+    static sf::Vector2f closestPointOnSegment(const Segment &s, const sf::Vector2f &p) {
+        sf::Vector2f ab = s.b - s.a;
+        float lengthSq = dot(ab, ab);
+        if (lengthSq == 0.0f) return s.a;
+        float t = std::clamp(dot(p - s.a, ab) / lengthSq, 0.0f, 1.0f);
+        return s.a + ab * t;
+    }
+
+    // Move the particle to newPosition and bounce it off the surface with the given normal
+    static void bounce(prtcl::Particle &p, const sf::Vector2f &newPosition, const sf::Vector2f &normal) {
+        sf::Vector2f vel = p.getVelocity();
+        p.position = newPosition;
+
+        float velocityAlongNormal = dot(vel, normal);
+        if (velocityAlongNormal < 0) {
+            vel -= (1 + p.restitution) * velocityAlongNormal * normal;
+        }
+        p.setVelocity(vel);
+    }
+
+    // Push the particle out to minDist from the contact point
+    static void pushOut(prtcl::Particle &p, const sf::Vector2f &contact, const sf::Vector2f &fallbackNormal,
+                        float minDist) {
+        sf::Vector2f diff = p.position - contact;
+        float distSq = dot(diff, diff);
+        if (distSq >= minDist * minDist) return;
+
+        float dist = std::sqrt(distSq);
+        sf::Vector2f normal = (dist > 0) ? diff / dist : fallbackNormal;
+        bounce(p, contact + normal * minDist, normal);
+    }
+
+    // A segment has no thickness, so the closest point alone can't tell a particle touching it from one
+    // pushed through it. Along the segment the particle goes back to its own side, past the ends it is
+    // pushed off the end point.
+    static void pushOutOfSegment(prtcl::Particle &p, const Segment &s) {
+        sf::Vector2f ab = s.b - s.a;
+        float lengthSq = dot(ab, ab);
+        float t = lengthSq > 0 ? dot(p.position - s.a, ab) / lengthSq : -1.0f;
+        if (t < 0 || t > 1) {
+            const sf::Vector2f &end = t > 1 ? s.b : s.a;
+            pushOut(p, end, sf::Vector2f(0.f, -1.f), p.radius);
+            return;
+        }
+
+        float side = static_cast<float>(s.side);
+        if (side == 0) {
+            float from = cross(ab, p.oldPosition - s.a);
+            if (from == 0) from = cross(ab, p.position - s.a);
+            side = from < 0 ? -1.0f : 1.0f;
+        }
+
+        sf::Vector2f normal = sf::Vector2f(-ab.y, ab.x) * (side / std::sqrt(lengthSq));
+        float distance = dot(p.position - s.a, normal);
+        if (distance >= p.radius) return;
+        bounce(p, p.position + normal * (p.radius - distance), normal);
+    }
+
+    void StaticGeometry::addSegment(const sf::Vector2f &a, const sf::Vector2f &b) {
+        segments.push_back({a, b});
+    }
+
+    void StaticGeometry::addPolygon(const std::vector<sf::Vector2f> &points) {
+        if (points.size() < 2) return;
+
+        // The winding tells which side of each edge is inside, flat outlines stay two sided
+        float area = 0;
+        for (size_t i = 0; i < points.size(); i++) {
+            area += cross(points[i], points[(i + 1) % points.size()]);
+        }
+        int outside = area > 0 ? -1 : (area < 0 ? 1 : 0);
+
+        for (size_t i = 0; i < points.size(); i++) {
+            segments.push_back({points[i], points[(i + 1) % points.size()], outside});
+        }
+    }
+
+    void StaticGeometry::addCircle(const sf::Vector2f &center, float radius) {
+        circles.push_back({center, radius});
+    }
+
+    bool StaticGeometry::loadFromFile(const std::string &path, std::string &error) {
+        std::ifstream file(path);
+        if (!file) {
+            error = "No scene file found (" + path + ")";
+            return false;
+        }
+
+        // Shapes are only kept once the whole file parsed
+        StaticGeometry loaded;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line)) {
+            lineNumber++;
+            line = line.substr(0, line.find('#'));
+
+            std::istringstream in(line);
+            std::string kind;
+            if (!(in >> kind)) continue;
+
+            std::vector<float> values;
+            float v;
+            while (in >> v) values.push_back(v);
+            bool allNumbers = in.eof();
+
+            if (allNumbers && kind == "segment" && values.size() == 4) {
+                loaded.addSegment({values[0], values[1]}, {values[2], values[3]});
+            } else if (allNumbers && kind == "polygon" && values.size() >= 6 && values.size() % 2 == 0) {
+                std::vector<sf::Vector2f> points;
+                for (size_t i = 0; i < values.size(); i += 2) {
+                    points.emplace_back(values[i], values[i + 1]);
+                }
+                loaded.addPolygon(points);
+            } else if (allNumbers && kind == "circle" && values.size() == 3 && values[2] > 0) {
+                loaded.addCircle({values[0], values[1]}, values[2]);
+            } else {
+                error = path + ":" + std::to_string(lineNumber) + ": invalid shape '" + kind + "'";
+                return false;
+            }
+        }
+
+        segments.insert(segments.end(), loaded.segments.begin(), loaded.segments.end());
+        circles.insert(circles.end(), loaded.circles.begin(), loaded.circles.end());
+        return true;
+    }
+
+    void StaticGeometry::clear() {
+        segments.clear();
+        circles.clear();
+        segmentCells.clear();
+        circleCells.clear();
+    }
+
+    void StaticGeometry::bake(const UniformGrid &grid, float margin) {
+        segmentCells.assign(grid.gridWidth * grid.gridHeight, {});
+        circleCells.assign(grid.gridWidth * grid.gridHeight, {});
+
+        const float cellSize = static_cast<float>(grid.cellSize);
+        // A particle anywhere in the cell can reach shapes within margin of the cell bounds
+        const float halfDiagonal = cellSize * 0.70711f;
+        const float reach = margin + halfDiagonal;
+
+        auto forCellsInBox = [&](sf::Vector2f min, sf::Vector2f max, auto &&visit) {
+            int x0 = std::max(0, static_cast<int>(std::floor((min.x - grid.originX) / cellSize)));
+            int y0 = std::max(0, static_cast<int>(std::floor(min.y / cellSize)));
+            int x1 = std::min(grid.gridWidth - 1, static_cast<int>(std::floor((max.x - grid.originX) / cellSize)));
+            int y1 = std::min(grid.gridHeight - 1, static_cast<int>(std::floor(max.y / cellSize)));
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) {
+                    sf::Vector2f cellCenter(grid.originX + (x + 0.5f) * cellSize, (y + 0.5f) * cellSize);
+                    visit(y * grid.gridWidth + x, cellCenter);
+                }
+            }
+        };
+
+        for (int i = 0; i < static_cast<int>(segments.size()); i++) {
+            const Segment &s = segments[i];
+            sf::Vector2f min(std::min(s.a.x, s.b.x) - margin, std::min(s.a.y, s.b.y) - margin);
+            sf::Vector2f max(std::max(s.a.x, s.b.x) + margin, std::max(s.a.y, s.b.y) + margin);
+            forCellsInBox(min, max, [&](int cellIndex, const sf::Vector2f &cellCenter) {
+                sf::Vector2f diff = cellCenter - closestPointOnSegment(s, cellCenter);
+                if (dot(diff, diff) <= reach * reach) {
+                    segmentCells[cellIndex].push_back(i);
+                }
+            });
+        }
+
+        for (int i = 0; i < static_cast<int>(circles.size()); i++) {
+            const CircleObstacle &c = circles[i];
+            float extent = c.radius + margin;
+            sf::Vector2f min(c.center.x - extent, c.center.y - extent);
+            sf::Vector2f max(c.center.x + extent, c.center.y + extent);
+            forCellsInBox(min, max, [&](int cellIndex, const sf::Vector2f &cellCenter) {
+                sf::Vector2f diff = cellCenter - c.center;
+                float limit = c.radius + reach;
+                if (dot(diff, diff) <= limit * limit) {
+                    circleCells[cellIndex].push_back(i);
+                }
+            });
+        }
+    }
+
+    void StaticGeometry::resolveCollisions(prtcl::Particle &p, int cellIndex) const {
+        for (int i: segmentCells[cellIndex]) {
+            pushOutOfSegment(p, segments[i]);
+        }
+
+        for (int i: circleCells[cellIndex]) {
+            const CircleObstacle &c = circles[i];
+            pushOut(p, c.center, sf::Vector2f(0.f, -1.f), c.radius + p.radius);
+        }
+    }
+
+    bool StaticGeometry::hasShapesInCell(int cellIndex) const {
+        return !segmentCells.empty() && (!segmentCells[cellIndex].empty() || !circleCells[cellIndex].empty());
+    }
+
+    const std::vector<Segment> &StaticGeometry::getSegments() const {
+        return segments;
+    }
+
+    const std::vector<CircleObstacle> &StaticGeometry::getCircles() const {
+        return circles;
+    }
+}
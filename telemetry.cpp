@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include "headers/telemetry.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+namespace telemetry {
+    static double bucketBoundSeconds(int bucket) {
+        return static_cast<double>(uint64_t(1) << bucket) * 1e-6;
+    }
+
+    void SlotCounters::addBusy(uint64_t ns) {
+        busyNs.store(busyNs.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    }
+
+    void SlotCounters::observeCellOccupancy(int occupancy) {
+        // Only the owning slot writes, no compare-exchange needed
+        if (occupancy > maxCellOccupancy.load(std::memory_order_relaxed)) {
+            maxCellOccupancy.store(occupancy, std::memory_order_relaxed);
+        }
+    }
+
+    Metrics::Metrics(int slotCount) : slots(slotCount) {
+    }
+
+    void Metrics::recordSubstep(uint64_t ns) {
+        int bucket = std::bit_width(ns / 1000);
+        if (bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+        latencyBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        latencySumNs.fetch_add(ns, std::memory_order_relaxed);
+        substepCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Metrics::recordParallelSection(uint64_t wallNs) {
+        parallelWallNs.fetch_add(wallNs, std::memory_order_relaxed);
+    }
+
+    SlotCounters &Metrics::slot(int index) {
+        return slots[index];
+    }
+
+    void Metrics::collect(Snapshot &out) {
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            out.latencyBuckets[i] = latencyBuckets[i].load(std::memory_order_relaxed);
+        }
+        out.latencySumNs = latencySumNs.load(std::memory_order_relaxed);
+        out.substepCount = substepCount.load(std::memory_order_relaxed);
+
+        uint64_t busy = 0;
+        out.maxCellOccupancy = 0;
+        for (auto &s: slots) {
+            busy += s.busyNs.exchange(0, std::memory_order_relaxed);
+            out.maxCellOccupancy = std::max(out.maxCellOccupancy, s.maxCellOccupancy.exchange(0, std::memory_order_relaxed));
+        }
+        uint64_t wall = parallelWallNs.exchange(0, std::memory_order_relaxed);
+        out.threadUtilisation = wall > 0 ? static_cast<double>(busy) / (static_cast<double>(wall) * slots.size()) : 0.0;
+    }
+
+    Exporter::Exporter(const std::string &path, float intervalSeconds)
+        : path(path),
+          prometheus(path.size() >= 5 && path.compare(path.size() - 5, 5, ".prom") == 0),
+          interval(intervalSeconds),
+          start(std::chrono::steady_clock::now()),
+          lastWrite(start) {
+    }
+
+    bool Exporter::due() const {
+        return std::chrono::steady_clock::now() - lastWrite >= interval;
+    }
+
+    // Atomically swaps tmpPath into place, std::rename won't overwrite an existing file on Windows
+    static bool replaceFile(const std::string &tmpPath, const std::string &path) {
+#ifdef _WIN32
+        return MoveFileExA(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+#endif
+    }
+
+    bool Exporter::write(const Snapshot &s) {
+        lastWrite = std::chrono::steady_clock::now();
+        if (prometheus) {
+            return writePrometheus(s);
+        }
+        return writeJsonLine(s, std::chrono::duration<double>(lastWrite - start).count());
+    }
+
+    bool Exporter::writeJsonLine(const Snapshot &s, double time) const {
+        std::ofstream out(path, std::ios::app);
+        // Fixed millisecond precision, long runs would otherwise switch to exponents and lose whole seconds
+        out << "{\"time\":" << std::fixed << std::setprecision(3) << time << std::defaultfloat << std::setprecision(6)
+                << ",\"substeps\":" << s.substeps
+                << ",\"particles\":" << s.particleCount
+                << ",\"substep_latency\":{\"le_seconds\":[";
+        for (int i = 0; i < LATENCY_BUCKETS - 1; i++) {
+            out << (i ? "," : "") << bucketBoundSeconds(i);
+        }
+        out << "],\"counts\":[";
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            out << (i ? "," : "") << s.latencyBuckets[i];
+        }
+        out << "],\"sum_seconds\":" << s.latencySumNs * 1e-9
+                << ",\"count\":" << s.substepCount << "}"
+                << ",\"max_cell_occupancy\":" << s.maxCellOccupancy
+                << ",\"escaped_particles\":" << s.escapedParticles
+                << ",\"kinetic_energy\":" << s.kineticEnergy
+                << ",\"thread_utilisation\":" << s.threadUtilisation
+                << "}\n";
+        return static_cast<bool>(out);
+    }
+
+    bool Exporter::writePrometheus(const Snapshot &s) const {
+        std::ostringstream out;
+        out << "# HELP particle_sim_substep_seconds Wall time of one simulation substep\n"
+                << "# TYPE particle_sim_substep_seconds histogram\n";
+        uint64_t cumulative = 0;
+        for (int i = 0; i < LATENCY_BUCKETS - 1; i++) {
+            cumulative += s.latencyBuckets[i];
+            out << "particle_sim_substep_seconds_bucket{le=\"" << bucketBoundSeconds(i) << "\"} " << cumulative << "\n";
+        }
+        out << "particle_sim_substep_seconds_bucket{le=\"+Inf\"} " << s.substepCount << "\n"
+                << "particle_sim_substep_seconds_sum " << s.latencySumNs * 1e-9 << "\n"
+                << "particle_sim_substep_seconds_count " << s.substepCount << "\n";
+
+        auto gauge = [&out](const char *name, const char *help, auto value) {
+            out << "# HELP " << name << " " << help << "\n"
+                    << "# TYPE " << name << " gauge\n"
+                    << name << " " << value << "\n";
+        };
+        gauge("particle_sim_substeps", "Substeps per frame", s.substeps);
+        gauge("particle_sim_particles", "Simulated particles", s.particleCount);
+        gauge("particle_sim_max_cell_occupancy", "Most particles in one grid cell since the last export",
+              s.maxCellOccupancy);
+        gauge("particle_sim_escaped_particles", "Particles outside the world bounds", s.escapedParticles);
+        gauge("particle_sim_kinetic_energy", "Total kinetic energy, unit mass, pixels per second",
+              s.kineticEnergy);
+        gauge("particle_sim_thread_utilisation", "Busy fraction of the thread pool during collision passes",
+              s.threadUtilisation);
+
+        // Write then rename so scrapers never read a half written file
+        std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::trunc);
+            file << out.str();
+            if (!file) return false;
+        }
+        if (replaceFile(tmpPath, path)) return true;
+
+        // Rename refused (file locked by a reader...), fall back to rewriting in place
+        std::remove(tmpPath.c_str());
+        std::ofstream file(path, std::ios::trunc);
+        file << out.str();
+        return static_cast<bool>(file);
+    }
+}